@@ -0,0 +1,315 @@
+#include "parser.hpp"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define CONFIG_USE_MMAP
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__APPLE__)
+#define CONFIG_MTIME_NSEC(status) (status).st_mtimespec.tv_nsec
+#else
+#define CONFIG_MTIME_NSEC(status) (status).st_mtim.tv_nsec
+#endif
+
+#define CONFIG_CACHE_MAGIC "APPC"
+#define CONFIG_CACHE_VERSION 2
+
+namespace ArgParse{
+  namespace{
+    bool isBlank(char c){
+      return c == ' ' || c == '\t' || c == '\r';
+    }
+    std::string trim(const char* beg, const char* end){
+      while (beg != end && isBlank(*beg)) beg++;
+      while (end != beg && isBlank(*(end - 1))) end--;
+      return std::string(beg, end);
+    }
+#ifdef CONFIG_USE_MMAP
+    /**
+     * @brief read only memory mapping of a whole file, unmapped on destruction.
+     * Files that are not regular files (pipes, /dev/stdin, procfs) can not be
+     * mapped and are read into a buffer instead.
+    */
+    class MappedFile{
+      public:
+        MappedFile(const std::string& path){
+          _fd = ::open(path.c_str(), O_RDONLY);
+          if (_fd < 0)
+            return;
+          if (::fstat(_fd, &_status) != 0){
+            _close();
+            return;
+          }
+          if (!isRegular()){
+            _read();
+            return;
+          }
+          _size = static_cast<size_t>(_status.st_size);
+          if (_size == 0)
+            return;
+          void* data = ::mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, _fd, 0);
+          if (data != MAP_FAILED){
+            _data = static_cast<const char*>(data);
+            _mapped = true;
+          }
+        }
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        ~MappedFile(){
+          if (_mapped)
+            ::munmap(const_cast<char*>(_data), _size);
+          _close();
+        }
+        bool isOpen() const{
+          return _fd >= 0 && (_size == 0 || _data != nullptr);
+        }
+        bool isRegular() const{
+          return S_ISREG(_status.st_mode);
+        }
+        const char* data() const{
+          return _data;
+        }
+        size_t size() const{
+          return _size;
+        }
+        const struct stat& status() const{
+          return _status;
+        }
+      private:
+        int _fd = -1;
+        const char* _data = nullptr;
+        size_t _size = 0;
+        bool _mapped = false;
+        std::string _buffer;
+        struct stat _status;
+
+        void _close(){
+          if (_fd >= 0)
+            ::close(_fd);
+          _fd = -1;
+        }
+        void _read(){
+          char chunk[4096];
+          while (true){
+            ssize_t count = ::read(_fd, chunk, sizeof(chunk));
+            if (count == 0)
+              break;
+            if (count < 0){
+              if (errno == EINTR)
+                continue;
+              _close();
+              return;
+            }
+            _buffer.append(chunk, static_cast<size_t>(count));
+          }
+          _data = _buffer.data();
+          _size = _buffer.size();
+        }
+    };
+    /* Followed by the path of the config file and the entries */
+    struct CacheHeader{
+      char magic[4];
+      uint32_t version;
+      uint64_t device;
+      uint64_t inode;
+      int64_t mtimeSec;
+      int64_t mtimeNsec;
+      uint64_t size;
+      uint64_t count;
+    };
+    std::string absolutePath(const std::string& path){
+      char resolved[PATH_MAX];
+      if (::realpath(path.c_str(), resolved) == nullptr)
+        return path;
+      return resolved;
+    }
+    bool readString(const char*& cur, const char* end, std::string& out){
+      uint64_t length;
+      if (static_cast<size_t>(end - cur) < sizeof(length))
+        return false;
+      std::memcpy(&length, cur, sizeof(length));
+      cur += sizeof(length);
+      if (static_cast<uint64_t>(end - cur) < length)
+        return false;
+      out.assign(cur, length);
+      cur += length;
+      return true;
+    }
+    void writeString(std::ostream& stream, const std::string& s){
+      uint64_t length = s.size();
+      stream.write(reinterpret_cast<const char*>(&length), sizeof(length));
+      stream.write(s.data(), s.size());
+    }
+#endif
+  }
+#ifdef CONFIG_USE_MMAP
+  void ConfigFile::load(const std::string& path, const std::string& cachePath){
+    clear();
+    MappedFile file(path);
+    if (!file.isOpen())
+      throw GenericParserError("Unable to read config file \'" + path + "\'");
+    // The stamp of a pipe or a device says nothing about its content
+    if (!file.isRegular()){
+      _parse(file.data(), file.size(), path);
+      _loaded = true;
+      return;
+    }
+    const struct stat& status = file.status();
+    Stamp stamp = {
+      absolutePath(path),
+      static_cast<uint64_t>(status.st_dev),
+      static_cast<uint64_t>(status.st_ino),
+      static_cast<int64_t>(status.st_mtime),
+      static_cast<int64_t>(CONFIG_MTIME_NSEC(status)),
+      static_cast<uint64_t>(status.st_size)
+    };
+    if (!cachePath.empty() && _loadCache(cachePath, stamp)){
+      _loaded = true;
+      return;
+    }
+    _parse(file.data(), file.size(), path);
+    if (!cachePath.empty())
+      _saveCache(cachePath, stamp);
+    _loaded = true;
+  }
+#else
+  void ConfigFile::load(const std::string& path, const std::string&){
+    clear();
+    std::ifstream stream(path, std::ios::binary);
+    if (!stream)
+      throw GenericParserError("Unable to read config file \'" + path + "\'");
+    std::string data(
+      (std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>()
+    );
+    _parse(data.data(), data.size(), path);
+    _loaded = true;
+  }
+#endif
+  bool ConfigFile::isLoaded() const{
+    return _loaded;
+  }
+  bool ConfigFile::has(const std::string& key) const{
+    return _values.count(key) != 0;
+  }
+  const std::string& ConfigFile::get(const std::string& key) const{
+    auto entry = _values.find(key);
+    if (entry == _values.end())
+      throw OutOfBounds(key);
+    return entry->second;
+  }
+  void ConfigFile::clear(){
+    _values.clear();
+    _loaded = false;
+  }
+  void ConfigFile::_parse(
+    const char* data, size_t size, const std::string& path
+  ){
+    const char* end = data + size;
+    size_t lineCount = 0;
+    while (data != end){
+      const char* lineEnd = static_cast<const char*>(
+        std::memchr(data, '\n', end - data)
+      );
+      if (lineEnd == nullptr)
+        lineEnd = end;
+      lineCount += 1;
+      const char* beg = data;
+      while (beg != lineEnd && isBlank(*beg)) beg++;
+      if (beg != lineEnd && *beg != '#'){
+        const char* sep = static_cast<const char*>(
+          std::memchr(beg, '=', lineEnd - beg)
+        );
+        std::string key = sep == nullptr ? "" : trim(beg, sep);
+        if (key.empty())
+          throw GenericParserError(
+            "Invalid entry at line " + std::to_string(lineCount) +
+            " of config file \'" + path + "\'"
+          );
+        _values[std::move(key)] = trim(sep + 1, lineEnd);
+      }
+      data = lineEnd == end ? end : lineEnd + 1;
+    }
+  }
+#ifdef CONFIG_USE_MMAP
+  bool ConfigFile::_loadCache(const std::string& cachePath, const Stamp& stamp){
+    MappedFile file(cachePath);
+    if (
+      !file.isOpen() || !file.isRegular() || file.size() < sizeof(CacheHeader)
+    )
+      return false;
+    CacheHeader header;
+    std::memcpy(&header, file.data(), sizeof(header));
+    bool isValidHeader = 
+      std::memcmp(header.magic, CONFIG_CACHE_MAGIC, sizeof(header.magic)) == 0;
+    if (
+      !isValidHeader ||
+      header.version != CONFIG_CACHE_VERSION ||
+      header.device != stamp.device ||
+      header.inode != stamp.inode ||
+      header.mtimeSec != stamp.mtimeSec ||
+      header.mtimeNsec != stamp.mtimeNsec ||
+      header.size != stamp.size
+    )
+      return false;
+    const char* cur = file.data() + sizeof(header);
+    const char* end = file.data() + file.size();
+    std::string path;
+    if (!readString(cur, end, path) || path != stamp.path)
+      return false;
+    for (uint64_t i = 0; i < header.count; i++){
+      std::string key;
+      std::string value;
+      if (!readString(cur, end, key) || !readString(cur, end, value)){
+        _values.clear();
+        return false;
+      }
+      _values.emplace_hint(_values.end(), std::move(key), std::move(value));
+    }
+    return true;
+  }
+  void ConfigFile::_saveCache(
+    const std::string& cachePath, const Stamp& stamp
+  ) const{
+    // Written to a temporary file first so concurrent readers never see a
+    // partially written cache. Failing to write the cache is not an error.
+    std::string tmpPath = cachePath + ".tmp" + std::to_string(::getpid());
+    {
+      std::ofstream stream(tmpPath, std::ios::binary | std::ios::trunc);
+      if (!stream)
+        return;
+      CacheHeader header;
+      std::memcpy(header.magic, CONFIG_CACHE_MAGIC, sizeof(header.magic));
+      header.version   = CONFIG_CACHE_VERSION;
+      header.device    = stamp.device;
+      header.inode     = stamp.inode;
+      header.mtimeSec  = stamp.mtimeSec;
+      header.mtimeNsec = stamp.mtimeNsec;
+      header.size      = stamp.size;
+      header.count     = _values.size();
+      stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+      writeString(stream, stamp.path);
+      for (const auto& [key, value] : _values){
+        writeString(stream, key);
+        writeString(stream, value);
+      }
+      if (!stream){
+        stream.close();
+        std::remove(tmpPath.c_str());
+        return;
+      }
+    }
+    if (std::rename(tmpPath.c_str(), cachePath.c_str()) != 0)
+      std::remove(tmpPath.c_str());
+  }
+#endif
+};
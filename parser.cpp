@@ -1,6 +1,50 @@
 #include "parser.hpp"
+#include <cctype>
+#include <cstdlib>
+#include <algorithm>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define HELP_USE_IOCTL
+#include <sys/ioctl.h>
+#include <unistd.h>
+#endif
+
+#define HELP_DEFAULT_WIDTH 80
+#define HELP_INDENT size_t(2)
+#define HELP_GAP size_t(2)
+#define HELP_MIN_TEXT_WIDTH size_t(20)
 
 namespace ArgParse{
+  namespace{
+    /**
+     * @brief width of the terminal the help message is written to
+    */
+    size_t terminalWidth(){
+#ifdef HELP_USE_IOCTL
+      winsize size;
+      if (::ioctl(STDERR_FILENO, TIOCGWINSZ, &size) == 0 && size.ws_col > 0)
+        return size.ws_col;
+#endif
+      const char* columns = std::getenv("COLUMNS");
+      if (columns != nullptr && std::atoi(columns) > 0)
+        return static_cast<size_t>(std::atoi(columns));
+      return HELP_DEFAULT_WIDTH;
+    }
+    bool isSpace(char c){
+      return std::isspace(static_cast<unsigned char>(c));
+    }
+    /**
+     * @brief count of a flag taken from the environment or a config file. A
+     * number is used as the count, values starting with t or y count as once
+    */
+    uint32_t flagCountFromValue(const char* value){
+      if (std::isdigit(static_cast<unsigned char>(*value)))
+        return static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+      char firstCharacter = *value;
+      return firstCharacter == 't' || firstCharacter == 'T' ||
+        firstCharacter == 'y' || firstCharacter == 'Y';
+    }
+  }
   const char* ParserError::what() const noexcept{
     return "Unknown parsing error";
   }
@@ -63,6 +107,40 @@ namespace ArgParse{
     _data.clear();
     _isInitialized = false;
   }
+  size_t FlagSet::add(){
+    size_t id = _counts.size();
+    _counts.push_back(0);
+    if ((id >> 6) >= _bits.size()){
+      _bits.push_back(0);
+      _given.push_back(0);
+    }
+    return id;
+  }
+  void FlagSet::set(size_t id){
+    _bits[id >> 6] |= uint64_t(1) << (id & 63);
+    _given[id >> 6] |= uint64_t(1) << (id & 63);
+    _counts[id] += 1;
+  }
+  void FlagSet::unset(size_t id){
+    _bits[id >> 6] &= ~(uint64_t(1) << (id & 63));
+    _given[id >> 6] |= uint64_t(1) << (id & 63);
+    _counts[id] = 0;
+  }
+  void FlagSet::assign(size_t id, uint32_t count){
+    if (count != 0)
+      _bits[id >> 6] |= uint64_t(1) << (id & 63);
+    else
+      _bits[id >> 6] &= ~(uint64_t(1) << (id & 63));
+    _counts[id] = count;
+  }
+  size_t FlagSet::size() const{
+    return _counts.size();
+  }
+  void FlagSet::clear(){
+    std::fill(_bits.begin(), _bits.end(), 0);
+    std::fill(_given.begin(), _given.end(), 0);
+    std::fill(_counts.begin(), _counts.end(), 0);
+  }
   Args::Args(
     std::string&& helpString, bool required, bool many, 
     std::string&& defaultValue
@@ -106,6 +184,13 @@ namespace ArgParse{
     if (!doesKeyExist(key))
       throw OutOfBounds(key);
   }
+  bool Parser::doesFlagExist(const Key& key) const{
+    return _flagIds.count(key) != 0;
+  }
+  void Parser::_flagExistOrException(const Key& key) const{
+    if (!doesFlagExist(key))
+      throw OutOfBounds(key);
+  }
   bool Parser::doesPosExist(size_t pos) const{
     return pos < _args.size();
   }
@@ -141,19 +226,167 @@ namespace ArgParse{
     _keyExistOrException(key);
     return _kwargs.at(key).data();
   }
+  size_t Parser::addFlag(Key&& key, std::string&& helpString){
+    if (!validateKey(key))
+      throw InvalidKey(key);
+    Key name = _keyNameFromKey(key);
+    if (doesKeyExist(name) || doesFlagExist(name))
+      throw InvalidKey(key);
+    size_t id = _flags.add();
+    _flagIds.emplace(std::move(name), id);
+    _flagHelp.emplace_back(std::move(helpString));
+    _helpRendered = false;
+    return id;
+  }
+  size_t Parser::flagId(const Key& key) const{
+    _flagExistOrException(key);
+    return _flagIds.at(key);
+  }
+  bool Parser::isFlagSet(const Key& key) const{
+    _parsedOrException();
+    return isFlagSet(flagId(key));
+  }
+  uint32_t Parser::flagCount(const Key& key) const{
+    _parsedOrException();
+    return flagCount(flagId(key));
+  }
+  void Parser::useEnvironment(std::string&& prefix){
+    _envPrefix = std::move(prefix);
+    _useEnv = true;
+  }
+  void Parser::useConfigFile(std::string&& path, std::string&& cachePath){
+    _configPath = std::move(path);
+    _configCachePath = std::move(cachePath);
+    _config.clear();
+  }
+  std::string Parser::_envNameFromKey(const Key& key) const{
+    std::string name = _envPrefix;
+    name.reserve(_envPrefix.size() + key.size());
+    for (char c : key){
+      name.push_back(c == '-' ? '_' : static_cast<char>(
+        std::toupper(static_cast<unsigned char>(c))
+      ));
+    }
+    return name;
+  }
+  const char* Parser::_layeredValue(const Key& key) const{
+    if (_useEnv){
+      const char* value = std::getenv(_envNameFromKey(key).c_str());
+      if (value != nullptr)
+        return value;
+    }
+    if (_config.has(key))
+      return _config.get(key).c_str();
+    return nullptr;
+  }
+  std::string Parser::_layeredDefault(const Key& key, const Args& entry) const{
+    const char* value = _layeredValue(key);
+    return value != nullptr ? value : entry.defaultValue();
+  }
   void Parser::getHelpString(std::ostream& stream) const{
-    stream << "Ordered Arguments List : \n";
-    for (const auto& entry : _args){
-      stream << "\t" << entry.helpString();
-      stream <<  " default : " << entry.defaultValue() << "\n";
+    std::string_view help = helpString();
+    stream.write(help.data(), help.size());
+  }
+  std::string_view Parser::helpString() const{
+    if (!_helpRendered){
+      _renderHelp();
+      _helpRendered = true;
+    }
+    return _help;
+  }
+  void Parser::setHelpWidth(size_t width){
+    _helpWidth = width;
+    _helpRendered = false;
+  }
+  void Parser::_renderHelp() const{
+    // Names and descriptions of every entry, grouped by section
+    using Entry = std::pair<std::string, std::string>;
+    std::vector<std::pair<std::string, std::vector<Entry>>> sections;
+    auto describe = [](const Args& entry){
+      if (entry.defaultValue().empty())
+        return entry.helpString();
+      return entry.helpString() + " [default : " + entry.defaultValue() + "]";
+    };
+    auto keyName = [](const Key& key){
+      return key.length() == 1 ? "-" + key : "--" + key;
+    };
+    if (!_args.empty()){
+      sections.emplace_back("Ordered Arguments List :", std::vector<Entry>());
+      for (size_t i = 0; i < _args.size(); i++){
+        sections.back().second.emplace_back(
+          "<" + std::to_string(i) + ">", describe(_args.at(i))
+        );
+      }
+    }
+    if (!_kwargs.empty()){
+      sections.emplace_back("Keyword Arguments List :", std::vector<Entry>());
+      for (const auto& [key, entry] : _kwargs)
+        sections.back().second.emplace_back(keyName(key), describe(entry));
+    }
+    if (!_flagIds.empty()){
+      sections.emplace_back("Flag Arguments List :", std::vector<Entry>());
+      for (const auto& [key, id] : _flagIds)
+        sections.back().second.emplace_back(keyName(key), _flagHelp.at(id));
+    }
+    // Align descriptions on one column, names longer than half of the 
+    // terminal have their description start on the next line
+    size_t width = _helpWidth != 0 ? _helpWidth : terminalWidth();
+    size_t nameWidth = 0;
+    size_t totalSize = 0;
+    for (const auto& [title, entries] : sections){
+      totalSize += title.size() + 1;
+      for (const auto& [name, text] : entries){
+        nameWidth = std::max(nameWidth, name.size());
+        totalSize += name.size() + text.size();
+      }
     }
-    stream << "Keyword Arguments List : \n";
-    for(const auto& [key, entry] : _kwargs){
-      if (key.length() == 1) stream << "\t-" << key;
-      else stream << "\t--" << key;
-      stream << "\t\t : "<< entry.helpString();
-      stream <<  " default : " << entry.defaultValue() << "\n";
+    size_t column = std::min(
+      HELP_INDENT + nameWidth + HELP_GAP, std::max(width / 2, HELP_INDENT)
+    );
+    size_t textWidth = std::max(
+      width > column ? width - column : 0, HELP_MIN_TEXT_WIDTH
+    );
+    // Rendered into a new buffer that replaces the cached one
+    std::string help;
+    help.reserve(totalSize * 2);
+    for (const auto& [title, entries] : sections){
+      help.append(title).push_back('\n');
+      for (const auto& [name, text] : entries){
+        help.append(HELP_INDENT, ' ').append(name);
+        if (std::all_of(text.begin(), text.end(), isSpace)){
+          help.push_back('\n');
+          continue;
+        }
+        if (HELP_INDENT + name.size() + HELP_GAP > column)
+          help.append("\n").append(column, ' ');
+        else
+          help.append(column - HELP_INDENT - name.size(), ' ');
+        // Word wrap the description, any whitespace separates words
+        size_t lineSize = 0;
+        size_t beg = 0;
+        while (true){
+          while (beg < text.size() && isSpace(text.at(beg))) beg++;
+          if (beg == text.size())
+            break;
+          size_t end = beg;
+          while (end < text.size() && !isSpace(text.at(end))) end++;
+          size_t wordSize = end - beg;
+          if (lineSize != 0 && lineSize + 1 + wordSize > textWidth){
+            help.append("\n").append(column, ' ');
+            lineSize = 0;
+          }
+          else if (lineSize != 0){
+            help.push_back(' ');
+            lineSize += 1;
+          }
+          help.append(text, beg, wordSize);
+          lineSize += wordSize;
+          beg = end;
+        }
+        help.push_back('\n');
+      }
     }
+    _help = std::move(help);
   }
   void Parser::parse(
     int argc, char** argv, bool exitOnFail, bool printHelp
@@ -166,13 +399,14 @@ namespace ArgParse{
     }
     catch(const ParserError& e){
       if (exitOnFail){
-        std::cerr<< e.what() << std::endl;
-        if (printHelp) getHelpString(std::cerr);
+        std::string message = std::string(e.what()) + "\n";
+        if (printHelp) message.append(helpString());
+        std::cerr.write(message.data(), message.size());
         exit(1);
       }
       else{
         if (printHelp) getHelpString(std::cerr);
-        throw e;
+        throw;
       }
     }
     catch(const PrintHelp& e){
@@ -193,12 +427,55 @@ namespace ArgParse{
       key.length() > 2 && key.substr(0, 2) == "--"
     ));
   }
+  bool Parser::_parseFlag(const std::string& arg){
+    // Grouped single character flags, e.g. -vvv
+    if (arg.length() > 2 && arg.at(0) == '-' && arg.at(1) != '-'){
+      // A group with no registered flag is not a flag group, one with only
+      // some registered flags is a mistyped group
+      size_t unknown = arg.length();
+      bool hasFlag = false;
+      for(size_t i = 1; i < arg.length(); i++){
+        if (doesFlagExist(std::string(1, arg.at(i))))
+          hasFlag = true;
+        else if (unknown == arg.length())
+          unknown = i;
+      }
+      if (!hasFlag)
+        return false;
+      if (unknown != arg.length())
+        throw OutOfBounds("-" + std::string(1, arg.at(unknown)));
+      for(size_t i = 1; i < arg.length(); i++)
+        _flags.set(_flagIds.at(std::string(1, arg.at(i))));
+      return true;
+    }
+    if (!isKwargTag(arg))
+      return false;
+    Key key = _keyNameFromKey(arg);
+    auto flag = _flagIds.find(key);
+    if (flag != _flagIds.end()){
+      _flags.set(flag->second);
+      return true;
+    }
+    // Negated flags, e.g. --no-verbose
+    if (
+      key.length() > 3 && key.compare(0, 3, "no-") == 0 && !doesKeyExist(key)
+    ){
+      flag = _flagIds.find(key.substr(3));
+      if (flag != _flagIds.end()){
+        _flags.unset(flag->second);
+        return true;
+      }
+    }
+    return false;
+  }
   void Parser::_parseArgv(int argc, char** argv){
     size_t argCount = 0;
     bool haveKey = false;
     std::string curArgKey = "";
     for(size_t i = 1; i < argc; i++){
       std::string arg = argv[i];
+      if (!haveKey && _parseFlag(arg))
+        continue;
       bool isKwargStart = isKwargTag(arg);
       if (isKwargStart && !haveKey){
         if (!doesKeyExist(_keyNameFromKey(arg))){
@@ -232,15 +509,24 @@ namespace ArgParse{
     }
     for(auto& [key, entry] : _kwargs){
       if (!entry.isInitialized())
-        entry.appendOrSet(entry.defaultValue());
+        entry.appendOrSet(_layeredDefault(key, entry));
       if (entry.isRequired() && !entry.isInitialized())
         throw GenericParserError(
           "Inordered Argument \'" + key + "\' is not given"
         );
     }
+    for(const auto& [key, id] : _flagIds){
+      if (_flags.isGiven(id))
+        continue;
+      const char* value = _layeredValue(key);
+      if (value != nullptr)
+        _flags.assign(id, flagCountFromValue(value));
+    }
   }
   void Parser::_parse(int argc, char** argv){
     checkForHelpArgv(argc, argv);
+    if (!_configPath.empty() && !_config.isLoaded())
+      _config.load(_configPath, _configCachePath);
     _parseArgv(argc, argv);
   }
   void Parser::reset(bool keepArg){
@@ -253,11 +539,22 @@ namespace ArgParse{
   void Parser::_reset(){
     _kwargs.clear();
     _args.clear();
+    _flagIds.clear();
+    _flagHelp.clear();
+    _flags = FlagSet();
+    _helpRendered = false;
+    _helpWidth = 0;
+    _config.clear();
+    _configPath.clear();
+    _configCachePath.clear();
+    _envPrefix.clear();
+    _useEnv = false;
   }
   void Parser::_resetKeepArgument(){
     for(auto& [key, arg] : _kwargs)
       arg.clear();
     for(auto& arg : _args)
       arg.clear();
+    _flags.clear();
   }
 };
\ No newline at end of file
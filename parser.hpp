@@ -1,10 +1,12 @@
 #pragma once
 #include <string>
+#include <string_view>
 #include <functional>
 #include <vector>
 #include <map>
 #include <exception>
 #include <iostream>
+#include <cstdint>
 
 #define ARG_SEPARATOR ','
 
@@ -69,6 +71,61 @@ namespace ArgParse{
       std::string _data;
       bool _isInitialized = false;
   };
+  /**
+   * @brief an internal data structure to keep the state of flag arguments.
+   * Flags are indexed by their id, the state is kept as a packed bitset and a
+   * counter for every flag so checking a flag is a single bit test. Flags set
+   * or unset from argv are also marked as given, assign does not mark them so
+   * values from other sources can be told apart from argv.
+  */
+  class FlagSet{
+    public:
+      size_t add();
+      void set(size_t id);
+      void unset(size_t id);
+      void assign(size_t id, uint32_t count);
+      bool test(size_t id) const;
+      bool isGiven(size_t id) const;
+      uint32_t count(size_t id) const;
+      size_t size() const;
+      void clear();
+    private:
+      std::vector<uint64_t> _bits;
+      std::vector<uint64_t> _given;
+      std::vector<uint32_t> _counts;
+  };
+  /**
+   * @brief a key=value configuration file used as a source of default values.
+   * The file is memory mapped and indexed once when loaded. If a cache path is
+   * given, the indexed content is kept in a binary cache that is reused for as
+   * long as the file is the same and its modification time and size does not
+   * change. Memory mapping and the cache are only available on POSIX systems,
+   * elsewhere the file is read and indexed on every load.
+  */
+  class ConfigFile{
+    public:
+      void load(const std::string& path, const std::string& cachePath = "");
+      bool isLoaded() const;
+      bool has(const std::string& key) const;
+      const std::string& get(const std::string& key) const;
+      void clear();
+    private:
+      /* Identifies the version of the config file a cache was built from */
+      struct Stamp{
+        std::string path;
+        uint64_t device;
+        uint64_t inode;
+        int64_t mtimeSec;
+        int64_t mtimeNsec;
+        uint64_t size;
+      };
+      std::map<std::string, std::string> _values;
+      bool _loaded = false;
+
+      void _parse(const char* data, size_t size, const std::string& path);
+      bool _loadCache(const std::string& cachePath, const Stamp& stamp);
+      void _saveCache(const std::string& cachePath, const Stamp& stamp) const;
+  };
   /**
    * @brief a data structure that holds the data structure to keep the data for 
    * arguments.
@@ -122,7 +179,46 @@ namespace ArgParse{
        * this decision to include "--" is purely for ease of use
       */
       void addArgument(Key&& key, T&& ...args);
+      /**
+       * @brief adds a flag argument to the parser. A flag does not take a 
+       * value, its presence sets it, "--no-<key>" unsets it and repeating a 
+       * single character flag ("-vvv") counts it.
+       * @param key the key to use, including "--", for example : "--verbose"
+       * @return the id of the flag, which can be used with isFlagSet and 
+       * flagCount to check the flag without a lookup
+      */
+      size_t addFlag(Key&& key, std::string&& helpString = "");
+      /**
+       * @brief uses environment variables as a source of values for keyword
+       * arguments and flags not given in argv. The variable for "--log-level"
+       * with the prefix "APP_" is "APP_LOG_LEVEL". Environment variables take
+       * priority over the config file and the default value.
+      */
+      void useEnvironment(std::string&& prefix = "");
+      /**
+       * @brief uses a key=value config file as a source of values for keyword
+       * arguments and flags not given in argv or the environment. The file is
+       * loaded once when parse is called.
+       * @param path the path to the config file
+       * @param cachePath where to keep a binary cache of the indexed file, no
+       * cache is used if this is empty
+      */
+      void useConfigFile(std::string&& path, std::string&& cachePath = "");
+      /**
+       * @brief writes the help message into the stream with a single write
+      */
       void getHelpString(std::ostream& stream) const;
+      /**
+       * @brief obtains the help message. The message is laid out once for the
+       * arguments added to the parser, aligned and wrapped to the width of the
+       * terminal, and is reused until an argument is added.
+      */
+      std::string_view helpString() const;
+      /**
+       * @brief sets the width the help message is wrapped to. With 0 the width
+       * of the terminal is used, or COLUMNS if stderr is not a terminal.
+      */
+      void setHelpWidth(size_t width);
       /**
        * @brief Parses the contents of argv into the parser
        * @param argc argument count received from the main function
@@ -152,6 +248,19 @@ namespace ArgParse{
       template<typename T>
       std::vector<T> get(const Key& key, char sep) const;
 
+      /*
+        Obtaining the state of flags
+      */
+      size_t flagId(const Key& key) const;
+      bool isFlagSet(const Key& key) const;
+      uint32_t flagCount(const Key& key) const;
+      /**
+       * @brief checks the flag with the given id. No checks are done, the id
+       * should be obtained from addFlag or flagId.
+      */
+      bool isFlagSet(size_t id) const;
+      uint32_t flagCount(size_t id) const;
+
       /*
         Helper Functions
       */
@@ -165,6 +274,7 @@ namespace ArgParse{
       bool validateKey(const Key& key) const;
       bool doesKeyExist(const Key& key) const;
       bool doesPosExist(size_t pos) const;
+      bool doesFlagExist(const Key& key) const;
 
       /*
         Operation on the parser itself
@@ -174,12 +284,29 @@ namespace ArgParse{
     private:
       std::map<Key, Args> _kwargs;
       std::vector<Args> _args;
+      std::map<Key, size_t> _flagIds;
+      std::vector<std::string> _flagHelp;
+      FlagSet _flags;
+      ConfigFile _config;
+      std::string _configPath;
+      std::string _configCachePath;
+      std::string _envPrefix;
+      bool _useEnv = false;
       bool _parsed = false;
+      mutable std::string _help;
+      mutable bool _helpRendered = false;
+      size_t _helpWidth = 0;
 
       void _parse(int argc, char** argv);
       void _keyExistOrException(const Key& key) const;
       void _posExistOrException(size_t pos) const;
       void _parsedOrException() const;
+      void _flagExistOrException(const Key& key) const;
+      bool _parseFlag(const std::string& arg);
+      std::string _envNameFromKey(const Key& key) const;
+      const char* _layeredValue(const Key& key) const;
+      std::string _layeredDefault(const Key& key, const Args& entry) const;
+      void _renderHelp() const;
       Key _keyNameFromKey(const Key& key) const;
       void _parseArgv(int argc, char** argv);
       void _reset();
@@ -205,12 +332,14 @@ namespace ArgParse{
   template<typename... T>
   inline void Parser::addSeqArgument(T&& ...args){
     _args.emplace_back(std::forward<T>(args)...);
+    _helpRendered = false;
   }
   template<typename ...T>
   inline void Parser::addArgument(Key&& key, T&& ...args){
-    if (!validateKey(key))
+    if (!validateKey(key) || doesFlagExist(_keyNameFromKey(key)))
       throw InvalidKey(key);
     _kwargs.emplace(_keyNameFromKey(key), Args(std::forward<T>(args)...));
+    _helpRendered = false;
   }
   template<typename T>
   inline T Parser::get(size_t pos) const{
@@ -238,6 +367,21 @@ namespace ArgParse{
     const Args& arg = _kwargs.at(key);
     return arg.convert<T>(sep);
   }
+  inline bool FlagSet::test(size_t id) const{
+    return (_bits[id >> 6] >> (id & 63)) & 1;
+  }
+  inline bool FlagSet::isGiven(size_t id) const{
+    return (_given[id >> 6] >> (id & 63)) & 1;
+  }
+  inline uint32_t FlagSet::count(size_t id) const{
+    return _counts[id];
+  }
+  inline bool Parser::isFlagSet(size_t id) const{
+    return _flags.test(id);
+  }
+  inline uint32_t Parser::flagCount(size_t id) const{
+    return _flags.count(id);
+  }
   template<>
   inline double Args::convert<double>() const{
     return std::atof(_data.get().c_str());
@@ -5,6 +5,11 @@
 #include <random>
 #include <iostream>
 #include <sstream>
+#include <fstream>
+#include <cstdlib>
+#include <cstdio>
+#include <filesystem>
+#include <unistd.h>
 
 #define ASCII_MIN 32
 #define ASCII_MAX 127
@@ -31,6 +36,81 @@ std::string randomArgument(unsigned int argNameLength){
   return argName + generateRandomString(argNameLength);
 }
 
+/**
+ * @brief a file in the working directory that is removed when going out of
+ * scope, even if the test throws
+*/
+class ScopedFile{
+  public:
+    ScopedFile(std::string&& path){
+      _path = std::move(path);
+      std::remove(_path.c_str());
+    }
+    ~ScopedFile(){
+      std::remove(_path.c_str());
+    }
+    const std::string& path() const{
+      return _path;
+    }
+    void write(const std::string& content) const{
+      std::ofstream stream(_path, std::ios::binary | std::ios::trunc);
+      stream << content;
+    }
+    std::string read() const{
+      std::ifstream stream(_path, std::ios::binary);
+      std::stringstream content;
+      content << stream.rdbuf();
+      return content.str();
+    }
+    void setModificationTime(std::filesystem::file_time_type time) const{
+      std::filesystem::last_write_time(_path, time);
+    }
+    std::filesystem::file_time_type modificationTime() const{
+      return std::filesystem::last_write_time(_path);
+    }
+  private:
+    std::string _path;
+};
+
+/**
+ * @brief an environment variable that is unset when going out of scope
+*/
+class ScopedEnv{
+  public:
+    ScopedEnv(const std::string& name, const std::string& value){
+      _name = name;
+      setenv(_name.c_str(), value.c_str(), 1);
+    }
+    ~ScopedEnv(){
+      unsetenv(_name.c_str());
+    }
+  private:
+    std::string _name;
+};
+
+/**
+ * @brief replaces a value kept in the config cache, so a load that returns
+ * the replacement can only have been served from the cache
+*/
+void tamperCache(
+  const ScopedFile& cache, const std::string& from, const std::string& to
+){
+  std::string data = cache.read();
+  size_t pos = data.rfind(from);
+  if (pos == std::string::npos)
+    throw "value " + from + " is not in the cache";
+  data.replace(pos, from.size(), to);
+  cache.write(data);
+}
+
+std::string loadConfig(
+  const ScopedFile& config, const ScopedFile& cache, const std::string& key
+){
+  ArgParse::ConfigFile file;
+  file.load(config.path(), cache.path());
+  return file.get(key);
+}
+
 int main(){
   Test::TestCase seqTest("Named Argument Tests");
   ArgParse::Parser parser;
@@ -90,5 +170,264 @@ int main(){
       }
     }
   );
+  seqTest.addTest("Flag Argument parsing", 
+    [](){
+      ArgParse::Parser parser;
+      size_t verbose = parser.addFlag("-v", "Verbosity");
+      parser.addFlag("--color", "Colored output");
+      parser.addFlag("--dry", "Dry run");
+      parser.addArgument("--name", "Another help text");
+      int argc = 7;
+      char* argv[] = { 
+        "some_exec", "-vvv", "--dry", "--name", "nay", "--color", "--no-color"
+      };
+      parser.parse(argc, argv, false, false);
+      if (!parser.isFlagSet(verbose) || parser.flagCount(verbose) != 3)
+        throw std::string("v flag should have been counted 3 times");
+      if (!parser.isFlagSet("dry"))
+        throw std::string("dry flag should have been set");
+      if (parser.isFlagSet("color"))
+        throw std::string("color flag should have been negated");
+      if (parser.get("name") != "nay")
+        throw std::string("name argument should be equal to nay");
+    }
+  );
+  seqTest.addTest("Mistyped Flag group", 
+    [](){
+      ArgParse::Parser parser;
+      parser.addFlag("-v", "Verbosity");
+      parser.addSeqArgument("Input file", false);
+      int argc = 2;
+      char* argv[] = { "some_exec", "-vx" };
+      try{
+        parser.parse(argc, argv, false, false);
+      }
+      catch(const ArgParse::OutOfBounds& e){
+        if (std::string(e.what()).find("\'-x\'") == std::string::npos)
+          throw "error should name the unknown flag -x, got " + 
+            std::string(e.what());
+        return;
+      }
+      throw std::string("-vx should have thrown ArgParse::OutOfBounds");
+    }
+  );
+  seqTest.addTest("Flag Argument default", 
+    [](){
+      ArgParse::Parser parser;
+      size_t verbose = parser.addFlag("--verbose", "Verbosity");
+      int argc = 1;
+      char* argv[] = { "some_exec" };
+      parser.parse(argc, argv, false, false);
+      if (parser.isFlagSet(verbose) || parser.flagCount("verbose") != 0)
+        throw std::string("verbose flag should not have been set");
+    }
+  );
+  seqTest.addTest("Layered Argument defaults", 
+    [](){
+      ScopedFile config("argplusplus_test.conf");
+      config.write("# comment\nname = from-config\nlevel = 3\n");
+      ScopedEnv level("ARGPP_TEST_LEVEL", "from-env");
+      ArgParse::Parser parser;
+      parser.addArgument("--name", "Name", false);
+      parser.addArgument("--level", "Level", false);
+      parser.addArgument("--mode", "Mode", false, false, "from-default");
+      parser.addArgument("--file", "File", false);
+      parser.useEnvironment("ARGPP_TEST_");
+      parser.useConfigFile(std::string(config.path()));
+      int argc = 3;
+      char* argv[] = { "some_exec", "--file", "from-argv" };
+      parser.parse(argc, argv, false, false);
+      if (parser.get("file") != "from-argv")
+        throw std::string("file argument should be taken from argv");
+      if (parser.get("level") != "from-env")
+        throw std::string("level argument should be taken from environment");
+      if (parser.get("name") != "from-config")
+        throw std::string("name argument should be taken from config file");
+      if (parser.get("mode") != "from-default")
+        throw std::string("mode argument should be taken from default");
+    }
+  );
+  seqTest.addTest("Layered Flag values", 
+    [](){
+      ScopedFile config("argplusplus_test.conf");
+      config.write("dry = true\nquiet = false\n");
+      ScopedEnv verbose("ARGPP_TEST_V", "3");
+      ScopedEnv color("ARGPP_TEST_COLOR", "1");
+      ScopedEnv debug("ARGPP_TEST_DEBUG", "0");
+      ArgParse::Parser parser;
+      parser.addFlag("-v", "Verbosity");
+      parser.addFlag("--dry", "Dry run");
+      parser.addFlag("--quiet", "Quiet");
+      parser.addFlag("--color", "Colored output");
+      parser.addFlag("--debug", "Debug");
+      parser.useEnvironment("ARGPP_TEST_");
+      parser.useConfigFile(std::string(config.path()));
+      int argc = 3;
+      char* argv[] = { "some_exec", "--no-color", "--debug" };
+      parser.parse(argc, argv, false, false);
+      if (parser.flagCount("v") != 3)
+        throw std::string("v flag should be counted 3 times from environment");
+      if (!parser.isFlagSet("dry"))
+        throw std::string("dry flag should be set from config file");
+      if (parser.isFlagSet("quiet"))
+        throw std::string("quiet flag should be unset from config file");
+      if (parser.isFlagSet("color"))
+        throw std::string("negated color flag should take priority");
+      if (!parser.isFlagSet("debug") || parser.flagCount("debug") != 1)
+        throw std::string("debug flag from argv should take priority");
+    }
+  );
+  seqTest.addTest("Help String caching", 
+    [](){
+      ArgParse::Parser parser;
+      parser.addArgument("--name", "Another help text", false);
+      const char* cached = parser.helpString().data();
+      int argc = 1;
+      char* argv[] = { "some_exec" };
+      parser.parse(argc, argv, false, false);
+      if (parser.helpString().data() != cached)
+        throw std::string("help string should not be rendered again");
+      parser.addFlag("--verbose", "Verbosity");
+      std::string_view help = parser.helpString();
+      if (help.data() == cached)
+        throw std::string("help string should be rendered again");
+      if (help.find("--verbose") == std::string_view::npos)
+        throw std::string("help string should contain --verbose");
+    }
+  );
+  seqTest.addTest("Help String layout", 
+    [](){
+      ArgParse::Parser parser;
+      parser.addSeqArgument("Input file");
+      parser.addArgument(
+        "--name", "The name of the thing to be processed\nby the tool", 
+        false, false, "abc"
+      );
+      parser.addFlag("-q");
+      parser.addFlag("--verbose", "Print\tmore");
+      parser.setHelpWidth(40);
+      std::string expected = 
+        "Ordered Arguments List :\n"
+        "  <0>        Input file\n"
+        "Keyword Arguments List :\n"
+        "  --name     The name of the thing to be\n"
+        "             processed by the tool\n"
+        "             [default : abc]\n"
+        "Flag Arguments List :\n"
+        "  -q\n"
+        "  --verbose  Print more\n";
+      if (parser.helpString() != expected)
+        throw "help string is not laid out as expected, got\n" + 
+          std::string(parser.helpString());
+    }
+  );
   seqTest.runAll();
+
+  Test::TestCase configTest("Config File Tests");
+  configTest.addTest("Cold load writes cache", 
+    [](){
+      ScopedFile config("argplusplus_test.conf");
+      ScopedFile cache("argplusplus_test.cache");
+      config.write("name = aaa\n");
+      if (loadConfig(config, cache, "name") != "aaa")
+        throw std::string("name should be equal to aaa");
+      if (cache.read().compare(0, 4, "APPC") != 0)
+        throw std::string("cache should have been written");
+    }
+  );
+  configTest.addTest("Warm load reads cache", 
+    [](){
+      ScopedFile config("argplusplus_test.conf");
+      ScopedFile cache("argplusplus_test.cache");
+      config.write("name = aaa\nlevel = 3\n");
+      loadConfig(config, cache, "name");
+      if (
+        loadConfig(config, cache, "name") != "aaa" || 
+        loadConfig(config, cache, "level") != "3"
+      )
+        throw std::string("warm load should return the same values");
+      tamperCache(cache, "aaa", "zzz");
+      if (loadConfig(config, cache, "name") != "zzz")
+        throw std::string("warm load should have been served from cache");
+    }
+  );
+  configTest.addTest("Modification time invalidates cache", 
+    [](){
+      ScopedFile config("argplusplus_test.conf");
+      ScopedFile cache("argplusplus_test.cache");
+      config.write("name = aaa\n");
+      loadConfig(config, cache, "name");
+      tamperCache(cache, "aaa", "zzz");
+      config.setModificationTime(
+        config.modificationTime() + std::chrono::seconds(1)
+      );
+      if (loadConfig(config, cache, "name") != "aaa")
+        throw std::string("cache should be invalidated by modification time");
+    }
+  );
+  configTest.addTest("Content change invalidates cache", 
+    [](){
+      ScopedFile config("argplusplus_test.conf");
+      ScopedFile cache("argplusplus_test.cache");
+      config.write("name = aaa\n");
+      loadConfig(config, cache, "name");
+      config.write("name = bbbb\n");
+      if (loadConfig(config, cache, "name") != "bbbb")
+        throw std::string("cache should be invalidated by content change");
+    }
+  );
+  configTest.addTest("Different file invalidates cache", 
+    [](){
+      ScopedFile first("argplusplus_test_a.conf");
+      ScopedFile second("argplusplus_test_b.conf");
+      ScopedFile cache("argplusplus_test.cache");
+      first.write("k=1\n");
+      second.write("k=2\n");
+      second.setModificationTime(first.modificationTime());
+      if (loadConfig(first, cache, "k") != "1")
+        throw std::string("k should be equal to 1");
+      if (loadConfig(second, cache, "k") != "2")
+        throw std::string("cache of another file should not be used");
+    }
+  );
+  configTest.addTest("Corrupt cache falls back to config file", 
+    [](){
+      ScopedFile config("argplusplus_test.conf");
+      ScopedFile cache("argplusplus_test.cache");
+      config.write("name = aaa\n");
+      loadConfig(config, cache, "name");
+      std::string data = cache.read();
+      cache.write(data.substr(0, data.size() - 2));
+      if (loadConfig(config, cache, "name") != "aaa")
+        throw std::string("truncated cache should fall back to config file");
+      cache.write("not a cache");
+      if (loadConfig(config, cache, "name") != "aaa")
+        throw std::string("corrupt cache should fall back to config file");
+    }
+  );
+  configTest.addTest("Pipe is read without cache", 
+    [](){
+      ScopedFile cache("argplusplus_test.cache");
+      int fds[2];
+      if (pipe(fds) != 0)
+        throw std::string("unable to create pipe");
+      std::string content = "name = frompipe\n";
+      write(fds[1], content.data(), content.size());
+      close(fds[1]);
+      ArgParse::ConfigFile file;
+      try{
+        file.load("/dev/fd/" + std::to_string(fds[0]), cache.path());
+      }
+      catch(...){
+        close(fds[0]);
+        throw;
+      }
+      close(fds[0]);
+      if (file.get("name") != "frompipe")
+        throw std::string("name should be read from the pipe");
+      if (!cache.read().empty())
+        throw std::string("cache should not be written for a pipe");
+    }
+  );
+  configTest.runAll();
 }
\ No newline at end of file